@@ -7,6 +7,25 @@
 #include <numeric>
 #include <fstream>
 #include <sstream>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
 using namespace std;
 
@@ -200,21 +219,63 @@ CubeState applyMove(const CubeState &s, Move m) {
     return n;
 }
 
-bool is_move_allowed(Move last_move, Move curr_move) {
-    if (last_move == None) return true;
-    
-    int last_face = last_move / 3;
-    int curr_face = curr_move / 3;
+// Canonical move-sequence automaton. A state is the set of faces still "exposed" at the end of the
+// sequence, i.e. faces whose last turn commutes with every move made since. Turning an exposed face
+// again, or an exposed face of higher index that commutes with the new one, only re-orders or merges
+// moves that a canonical sequence already covers, so those moves are masked out. Commutation between
+// faces is derived from applyMove rather than hard-coded; for the cube it is transitive (same axis).
+const int FSM_START = 0;
+vector<int> fsm_faces;              // state -> exposed face mask
+vector<uint32_t> fsm_allowed;       // state -> mask of allowed next moves (bit i = Move i)
+vector<array<int, 18>> fsm_next;    // state x move -> next state
+
+void init_move_fsm() {
+    bool commutes[6][6];
+    for (int f = 0; f < 6; f++) {
+        for (int g = 0; g < 6; g++) {
+            CubeState a = applyMove(applyMove(CubeState(), (Move)(f * 3)), (Move)(g * 3));
+            CubeState b = applyMove(applyMove(CubeState(), (Move)(g * 3)), (Move)(f * 3));
+            commutes[f][g] = (a == b);
+        }
+    }
 
-    // Don't repeat same face
-    if (last_face == curr_face) return false;
-    
-    // Don't move opposite faces out of order (U/D, L/R, F/B)
-    if (last_face / 2 == curr_face / 2) {
-        if (last_face > curr_face) return false;
+    int index_of[64];
+    fill(begin(index_of), end(index_of), -1);
+    fsm_faces.assign(1, 0);
+    index_of[0] = FSM_START;
+
+    for (size_t st = 0; st < fsm_faces.size(); st++) {
+        int exposed = fsm_faces[st];
+        uint32_t allowed = 0;
+        array<int, 18> next;
+        next.fill(-1);
+        for (int f = 0; f < 6; f++) {
+            bool ok = true;
+            int next_exposed = 1 << f;
+            for (int g = 0; g < 6; g++) {
+                if (!(exposed & (1 << g)) || !commutes[f][g]) continue;
+                if (g >= f) ok = false;
+                next_exposed |= 1 << g;
+            }
+            if (!ok) continue;
+
+            if (index_of[next_exposed] == -1) {
+                index_of[next_exposed] = (int)fsm_faces.size();
+                fsm_faces.push_back(next_exposed);
+            }
+            for (int p = 0; p < 3; p++) {
+                allowed |= 1u << (f * 3 + p);
+                next[f * 3 + p] = index_of[next_exposed];
+            }
+        }
+        fsm_allowed.push_back(allowed);
+        fsm_next.push_back(next);
     }
-    
-    return true;
+}
+
+int fsm_run(int state, const vector<Move> &moves) {
+    for (Move m : moves) state = fsm_next[state][m];
+    return state;
 }
 
 // =================================================================================================
@@ -424,12 +485,43 @@ void set_slice_ep_coord(CubeState &s, int coord) {
 // --- PATTERN DATABASE ---
 // =================================================================================================
 
-vector<int> co_pdb(2187, -1);
-vector<int> eo_pdb(2048, -1);
-vector<int> slice_pdb(495, -1);
-vector<int> cp_pdb(40320, -1);
-vector<int> ud_ep_pdb(40320, -1);
-vector<int> slice_ep_pdb(24, -1);
+vector<Move> p1_moves = {Ux1, Ux2, Ux3, Dx1, Dx2, Dx3, Lx1, Lx2, Lx3, Rx1, Rx2, Rx3, Fx1, Fx2, Fx3, Bx1, Bx2, Bx3};
+vector<Move> p2_moves = {Ux1, Ux2, Ux3, Dx1, Dx2, Dx3, Lx2, Rx2, Fx2, Bx2};
+const uint32_t P2_MOVE_MASK = (1u << Ux1) | (1u << Ux2) | (1u << Ux3) | (1u << Dx1) | (1u << Dx2) | (1u << Dx3) |
+                              (1u << Lx2) | (1u << Rx2) | (1u << Fx2) | (1u << Bx2);
+
+// One pruning table over a single coordinate. Tables are loaded or generated independently; until
+// `ready` is set a table contributes 0 to the heuristic, which keeps the search admissible. The
+// table contents are written before `ready` is released and never change afterwards.
+struct PatternDB {
+    const char* file;
+    int goal;                                   // coordinate of the solved state
+    int (*get_coord)(const CubeState&);
+    void (*set_coord)(CubeState&, int);
+    const vector<Move>* moves;
+    vector<int> table;
+    atomic<bool> ready{false};
+
+    PatternDB(const char* f, int size, int g, int (*get)(const CubeState&), void (*set)(CubeState&, int),
+              const vector<Move>* m)
+        : file(f), goal(g), get_coord(get), set_coord(set), moves(m), table(size, -1) {}
+
+    int lookup(int coord) const {
+        return ready.load(memory_order_acquire) ? table[coord] : 0;
+    }
+};
+
+// Slice coordinate: C(11,4) + C(10,3) + C(9,2) + C(8,1) = 330 + 120 + 36 + 8 = 494
+// This represents the solved state where slice edges FR, FL, BL, BR (pieces 8-11)
+// are in their home positions (positions 8-11 in the middle layer)
+PatternDB co_pdb("co.pdb", 2187, 0, get_co_coord, set_co_coord, &p1_moves);
+PatternDB eo_pdb("eo.pdb", 2048, 0, get_eo_coord, set_eo_coord, &p1_moves);
+PatternDB slice_pdb("slice.pdb", 495, 494, get_slice_sorted_coord, set_slice_sorted_coord, &p1_moves);
+PatternDB cp_pdb("cp.pdb", 40320, 0, get_cp_coord, set_cp_coord, &p2_moves);
+PatternDB ud_ep_pdb("ud.pdb", 40320, 0, get_ud_ep_coord, set_ud_ep_coord, &p2_moves);
+PatternDB slice_ep_pdb("sep.pdb", 24, 0, get_slice_ep_coord, set_slice_ep_coord, &p2_moves);
+
+PatternDB* all_pdbs[] = {&co_pdb, &eo_pdb, &slice_pdb, &cp_pdb, &ud_ep_pdb, &slice_ep_pdb};
 
 void save_pdb(const string &filename, const vector<int> &pdb) {
     ofstream out(filename, ios::binary);
@@ -443,86 +535,29 @@ bool load_pdb(const string &filename, vector<int> &pdb) {
     return in.gcount() == (streamsize)(pdb.size() * sizeof(int));
 }
 
-void gen_p1_pdb() {
-    queue<int> q;
-    q.push(0); co_pdb[0] = 0;
-    while(!q.empty()){
-        int u = q.front(); q.pop();
-        int dist = co_pdb[u];
-        CubeState s; set_co_coord(s, u);
-        for(int m=0; m<18; m++) {
-            CubeState ns = applyMove(s, (Move)m);
-            int v = get_co_coord(ns);
-            if(co_pdb[v] == -1) { co_pdb[v] = dist+1; q.push(v); }
-        }
-    }
-    
-    q.push(0); eo_pdb[0] = 0;
-    while(!q.empty()){
-        int u = q.front(); q.pop();
-        int dist = eo_pdb[u];
-        CubeState s; set_eo_coord(s, u);
-        for(int m=0; m<18; m++) {
-            CubeState ns = applyMove(s, (Move)m);
-            int v = get_eo_coord(ns);
-            if(eo_pdb[v] == -1) { eo_pdb[v] = dist+1; q.push(v); }
-        }
-    }
-
-    // Slice coordinate: C(11,4) + C(10,3) + C(9,2) + C(8,1) = 330 + 120 + 36 + 8 = 494
-    // This represents the solved state where slice edges FR, FL, BL, BR (pieces 8-11)
-    // are in their home positions (positions 8-11 in the middle layer)
-    q.push(494); slice_pdb[494] = 0;
-    while(!q.empty()){
-        int u = q.front(); q.pop();
-        int dist = slice_pdb[u];
-        CubeState s; set_slice_sorted_coord(s, u);
-        for(int m=0; m<18; m++) {
-            CubeState ns = applyMove(s, (Move)m);
-            int v = get_slice_sorted_coord(ns);
-            if(slice_pdb[v] == -1) { slice_pdb[v] = dist+1; q.push(v); }
-        }
+// A loaded table is only trusted if the solved state is at distance 0 and every entry was reached.
+bool validate_pdb(const PatternDB &pdb) {
+    if (pdb.table[pdb.goal] != 0) return false;
+    for (int d : pdb.table) {
+        if (d < 0 || d > 20) return false;
     }
+    return true;
 }
 
-vector<Move> p2_moves = {Ux1, Ux2, Ux3, Dx1, Dx2, Dx3, Lx2, Rx2, Fx2, Bx2};
+void gen_pdb(PatternDB &pdb) {
+    vector<int> &dist_of = pdb.table;
+    fill(dist_of.begin(), dist_of.end(), -1);
 
-void gen_p2_pdb() {
     queue<int> q;
-    
-    q.push(0); cp_pdb[0] = 0;
-    while(!q.empty()){
-        int u = q.front(); q.pop();
-        int dist = cp_pdb[u];
-        CubeState s; set_cp_coord(s, u);
-        for(Move m : p2_moves) {
-            CubeState ns = applyMove(s, m);
-            int v = get_cp_coord(ns);
-            if(cp_pdb[v] == -1) { cp_pdb[v] = dist+1; q.push(v); }
-        }
-    }
-
-    q.push(0); ud_ep_pdb[0] = 0;
-    while(!q.empty()){
-        int u = q.front(); q.pop();
-        int dist = ud_ep_pdb[u];
-        CubeState s; set_ud_ep_coord(s, u);
-        for(Move m : p2_moves) {
-            CubeState ns = applyMove(s, m);
-            int v = get_ud_ep_coord(ns);
-            if(ud_ep_pdb[v] == -1) { ud_ep_pdb[v] = dist+1; q.push(v); }
-        }
-    }
-
-    q.push(0); slice_ep_pdb[0] = 0;
+    q.push(pdb.goal); dist_of[pdb.goal] = 0;
     while(!q.empty()){
         int u = q.front(); q.pop();
-        int dist = slice_ep_pdb[u];
-        CubeState s; set_slice_ep_coord(s, u);
-        for(Move m : p2_moves) {
+        int dist = dist_of[u];
+        CubeState s; pdb.set_coord(s, u);
+        for(Move m : *pdb.moves) {
             CubeState ns = applyMove(s, m);
-            int v = get_slice_ep_coord(ns);
-            if(slice_ep_pdb[v] == -1) { slice_ep_pdb[v] = dist+1; q.push(v); }
+            int v = pdb.get_coord(ns);
+            if(dist_of[v] == -1) { dist_of[v] = dist+1; q.push(v); }
         }
     }
 }
@@ -531,41 +566,119 @@ void gen_p2_pdb() {
 // --- SEARCH ---
 // =================================================================================================
 
-int h_p1(const CubeState &s) {
-    return max({co_pdb[get_co_coord(s)], eo_pdb[get_eo_coord(s)], slice_pdb[get_slice_sorted_coord(s)]});
+// When set, a node's children are all generated first and their pruning-table entries prefetched
+// before any child is evaluated, so the table misses overlap instead of being taken one child at a
+// time. When clear, each child is generated and looked up just before it is searched.
+bool prefetch_lookups = true;
+
+struct P1Coords { int co, eo, slice; };
+struct P2Coords { int cp, ud_ep, slice_ep; };
+
+P1Coords p1_coords(const CubeState &s) {
+    return {get_co_coord(s), get_eo_coord(s), get_slice_sorted_coord(s)};
+}
+
+P2Coords p2_coords(const CubeState &s) {
+    return {get_cp_coord(s), get_ud_ep_coord(s), get_slice_ep_coord(s)};
+}
+
+void prefetch_p1(const P1Coords &c) {
+    __builtin_prefetch(&co_pdb.table[c.co]);
+    __builtin_prefetch(&eo_pdb.table[c.eo]);
+    __builtin_prefetch(&slice_pdb.table[c.slice]);
+}
+
+void prefetch_p2(const P2Coords &c) {
+    __builtin_prefetch(&cp_pdb.table[c.cp]);
+    __builtin_prefetch(&ud_ep_pdb.table[c.ud_ep]);
+    __builtin_prefetch(&slice_ep_pdb.table[c.slice_ep]);
+}
+
+int h_p1(const P1Coords &c) {
+    return max({co_pdb.lookup(c.co), eo_pdb.lookup(c.eo), slice_pdb.lookup(c.slice)});
 }
 
-bool solve_p1(CubeState s, int g, int threshold, vector<Move>& path, Move lastMove) {
-    int h = h_p1(s);
-    if (h == 0) return true;
+bool is_p1_goal(const P1Coords &c) {
+    return c.co == co_pdb.goal && c.eo == eo_pdb.goal && c.slice == slice_pdb.goal;
+}
+
+// Each node receives its own coordinates from the parent's expansion pass and evaluates h_p1/h_p2
+// from them. The goal test uses the coordinates rather than h == 0, since h may be 0 while tables
+// are missing.
+bool solve_p1(const CubeState &s, const P1Coords &c, int g, int threshold, vector<Move>& path, int fsm) {
+    if (is_p1_goal(c)) return true;
+    int h = h_p1(c);
     if (g + h > threshold) return false;
 
-    for (int i = 0; i < 18; i++) {
-        Move m = (Move)i;
-        if (is_move_allowed(lastMove, m)) {
+    uint32_t allowed = fsm_allowed[fsm];
+    if (!prefetch_lookups) {
+        for (uint32_t mask = allowed; mask; mask &= mask - 1) {
+            Move m = (Move)__builtin_ctz(mask);
+            CubeState child = applyMove(s, m);
             path.push_back(m);
-            if (solve_p1(applyMove(s, m), g + 1, threshold, path, m)) return true;
+            if (solve_p1(child, p1_coords(child), g + 1, threshold, path, fsm_next[fsm][m])) return true;
             path.pop_back();
         }
+        return false;
+    }
+
+    CubeState child[18];
+    P1Coords coords[18];
+    Move moves[18];
+    int n = 0;
+    for (uint32_t mask = allowed; mask; mask &= mask - 1, n++) {
+        moves[n] = (Move)__builtin_ctz(mask);
+        child[n] = applyMove(s, moves[n]);
+        coords[n] = p1_coords(child[n]);
+        prefetch_p1(coords[n]);
+    }
+    for (int i = 0; i < n; i++) {
+        path.push_back(moves[i]);
+        if (solve_p1(child[i], coords[i], g + 1, threshold, path, fsm_next[fsm][moves[i]])) return true;
+        path.pop_back();
     }
     return false;
 }
 
-int h_p2(const CubeState &s) {
-    return max({cp_pdb[get_cp_coord(s)], ud_ep_pdb[get_ud_ep_coord(s)], slice_ep_pdb[get_slice_ep_coord(s)]});
+int h_p2(const P2Coords &c) {
+    return max({cp_pdb.lookup(c.cp), ud_ep_pdb.lookup(c.ud_ep), slice_ep_pdb.lookup(c.slice_ep)});
 }
 
-bool solve_p2(CubeState s, int g, int threshold, vector<Move>& path, Move lastMove) {
-    int h = h_p2(s);
-    if (h == 0) return true;
+bool is_p2_goal(const P2Coords &c) {
+    return c.cp == cp_pdb.goal && c.ud_ep == ud_ep_pdb.goal && c.slice_ep == slice_ep_pdb.goal;
+}
+
+bool solve_p2(const CubeState &s, const P2Coords &c, int g, int threshold, vector<Move>& path, int fsm) {
+    if (is_p2_goal(c)) return true;
+    int h = h_p2(c);
     if (g + h > threshold) return false;
 
-    for (Move m : p2_moves) {
-        if (is_move_allowed(lastMove, m)) {
+    uint32_t allowed = fsm_allowed[fsm] & P2_MOVE_MASK;
+    if (!prefetch_lookups) {
+        for (uint32_t mask = allowed; mask; mask &= mask - 1) {
+            Move m = (Move)__builtin_ctz(mask);
+            CubeState child = applyMove(s, m);
             path.push_back(m);
-            if (solve_p2(applyMove(s, m), g + 1, threshold, path, m)) return true;
+            if (solve_p2(child, p2_coords(child), g + 1, threshold, path, fsm_next[fsm][m])) return true;
             path.pop_back();
         }
+        return false;
+    }
+
+    CubeState child[18];
+    P2Coords coords[18];
+    Move moves[18];
+    int n = 0;
+    for (uint32_t mask = allowed; mask; mask &= mask - 1, n++) {
+        moves[n] = (Move)__builtin_ctz(mask);
+        child[n] = applyMove(s, moves[n]);
+        coords[n] = p2_coords(child[n]);
+        prefetch_p2(coords[n]);
+    }
+    for (int i = 0; i < n; i++) {
+        path.push_back(moves[i]);
+        if (solve_p2(child[i], coords[i], g + 1, threshold, path, fsm_next[fsm][moves[i]])) return true;
+        path.pop_back();
     }
     return false;
 }
@@ -645,36 +758,183 @@ bool parse_facelets(string f, CubeState &c) {
 string pdb_path = "./pdb";
 bool initialized = false;
 
+mutex pdb_mutex;
+condition_variable pdb_ready_cv;
+
+bool solver_ready() {
+    for (PatternDB* pdb : all_pdbs) {
+        if (!pdb->ready.load(memory_order_acquire)) return false;
+    }
+    return true;
+}
+
+// Reports each table as "name:ready" or "name:building", space separated.
+string solver_status() {
+    ostringstream status;
+    for (size_t i = 0; i < size(all_pdbs); i++) {
+        if (i > 0) status << " ";
+        status << all_pdbs[i]->file << (all_pdbs[i]->ready.load(memory_order_acquire) ? ":ready" : ":building");
+    }
+    return status.str();
+}
+
+void wait_solver_ready() {
+    unique_lock<mutex> lock(pdb_mutex);
+    pdb_ready_cv.wait(lock, solver_ready);
+}
+
+void build_pdb(PatternDB* pdb) {
+    gen_pdb(*pdb);
+    save_pdb(pdb_path + "/" + pdb->file, pdb->table);
+    {
+        lock_guard<mutex> lock(pdb_mutex);
+        pdb->ready.store(true, memory_order_release);
+    }
+    pdb_ready_cv.notify_all();
+}
+
+// Loads every table that is present and valid, and rebuilds the rest on background threads.
+// Requests are served immediately with whatever tables are ready; see solver_status().
 void initialize_solver(const string& path) {
     if (initialized) return;
     pdb_path = path;
     
     init_fact();
+    init_move_fsm();
 
-    bool gen = false;
-    if(!load_pdb(pdb_path + "/co.pdb", co_pdb)) gen=true;
-    if(!load_pdb(pdb_path + "/eo.pdb", eo_pdb)) gen=true;
-    if(!load_pdb(pdb_path + "/slice.pdb", slice_pdb)) gen=true;
-    if(!load_pdb(pdb_path + "/cp.pdb", cp_pdb)) gen=true;
-    if(!load_pdb(pdb_path + "/ud.pdb", ud_ep_pdb)) gen=true;
-    if(!load_pdb(pdb_path + "/sep.pdb", slice_ep_pdb)) gen=true;
-
-    if(gen) {
-        gen_p1_pdb();
-        save_pdb(pdb_path + "/co.pdb", co_pdb);
-        save_pdb(pdb_path + "/eo.pdb", eo_pdb);
-        save_pdb(pdb_path + "/slice.pdb", slice_pdb);
-
-        gen_p2_pdb();
-        save_pdb(pdb_path + "/cp.pdb", cp_pdb);
-        save_pdb(pdb_path + "/ud.pdb", ud_ep_pdb);
-        save_pdb(pdb_path + "/sep.pdb", slice_ep_pdb);
+    for (PatternDB* pdb : all_pdbs) {
+        if (load_pdb(pdb_path + "/" + pdb->file, pdb->table) && validate_pdb(*pdb)) {
+            pdb->ready.store(true, memory_order_release);
+        } else {
+            thread(build_pdb, pdb).detach();
+        }
     }
     
     initialized = true;
 }
 
-string solve(const string& facelet_string) {
+string moves_to_string(const vector<Move> &moves) {
+    ostringstream result;
+    for(size_t i = 0; i < moves.size(); i++) {
+        if(i > 0) result << " ";
+        result << move_strings[moves[i]];
+    }
+    return result.str();
+}
+
+// Runs both phases on a parsed, validated state. On failure returns false and sets error.
+bool solve_moves(const CubeState &start_state, vector<Move> &solution, string &error) {
+    vector<Move> p1_sol;
+    CubeState p1_end = start_state;
+    
+    P1Coords c1 = p1_coords(start_state);
+    int threshold = h_p1(c1);
+    while(true) {
+        if(solve_p1(start_state, c1, 0, threshold, p1_sol, FSM_START)) break;
+        threshold++;
+        if (threshold > 12) { error = "ERROR: Phase 1 exceeded depth limit"; return false; }
+    }
+
+    for(Move m : p1_sol) {
+        p1_end = applyMove(p1_end, m);
+    }
+
+    vector<Move> p2_sol;
+    int p1_fsm = fsm_run(FSM_START, p1_sol);
+    
+    P2Coords c2 = p2_coords(p1_end);
+    threshold = h_p2(c2);
+    while(true) {
+        if(solve_p2(p1_end, c2, 0, threshold, p2_sol, p1_fsm)) break;
+        threshold++;
+        if (threshold > 18) { error = "ERROR: Phase 2 exceeded depth limit"; return false; }
+    }
+
+    solution = p1_sol;
+    solution.insert(solution.end(), p2_sol.begin(), p2_sol.end());
+    return true;
+}
+
+// =================================================================================================
+// --- INCREMENTAL SOLVING ---
+// =================================================================================================
+
+// Interactive clients usually change the cube by a move or two between requests. A session keeps
+// the last state and its solution so such edits can be answered without a full two-phase search.
+struct SolveSession {
+    bool valid = false;
+    CubeState state;
+    vector<Move> solution;
+};
+
+const int INCREMENTAL_SEARCH_DEPTH = 3;   // depth of the search towards the old solution's states
+const int INCREMENTAL_MAX_LENGTH = 30;    // longer candidates fall back to a full solve
+
+Move inverse_move(Move m) {
+    return (Move)(m / 3 * 3 + 2 - m % 3);
+}
+
+bool parse_moves(const string &text, vector<Move> &moves) {
+    istringstream in(text);
+    string token;
+    while (in >> token) {
+        int found = -1;
+        for (int m = 0; m < 18; m++) {
+            if (move_strings[m] == token) { found = m; break; }
+        }
+        if (found == -1) return false;
+        moves.push_back((Move)found);
+    }
+    return true;
+}
+
+// Merges turns of the same face, including across a turn of the opposite face (e.g. U D U' -> D).
+vector<Move> simplify_moves(const vector<Move> &moves) {
+    vector<Move> out;
+    for (Move m : moves) {
+        int face = m / 3;
+        int power = m % 3 + 1;
+        int at = -1;
+        if (!out.empty() && out.back() / 3 == face) {
+            at = (int)out.size() - 1;
+        } else if (out.size() >= 2 && out.back() / 6 == face / 2 && out[out.size() - 2] / 3 == face) {
+            at = (int)out.size() - 2;
+        }
+
+        if (at == -1) { out.push_back(m); continue; }
+        power = (power + out[at] % 3 + 1) % 4;
+        if (power == 0) out.erase(out.begin() + at);
+        else out[at] = (Move)(face * 3 + power - 1);
+    }
+    return out;
+}
+
+// Depth-limited search from the new state; whenever it reaches one of the old solution's
+// intermediate states, the path plus the rest of the old solution is a candidate.
+void search_intermediates(const CubeState &s, int depth, int fsm, vector<Move> &path,
+                          const vector<CubeState> &targets, const vector<Move> &old_solution,
+                          vector<Move> &best) {
+    if (path.size() >= best.size()) return;
+
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (!(s == targets[i])) continue;
+        vector<Move> candidate = path;
+        candidate.insert(candidate.end(), old_solution.begin() + i, old_solution.end());
+        candidate = simplify_moves(candidate);
+        if (candidate.size() < best.size()) best = candidate;
+    }
+    if (depth == 0) return;
+
+    for (uint32_t mask = fsm_allowed[fsm]; mask; mask &= mask - 1) {
+        Move m = (Move)__builtin_ctz(mask);
+        path.push_back(m);
+        search_intermediates(applyMove(s, m), depth - 1, fsm_next[fsm][m], path, targets, old_solution, best);
+        path.pop_back();
+    }
+}
+
+// Full solve from a facelet string; on success the session is reset to this state and solution.
+string solve_session(SolveSession &session, const string& facelet_string) {
     if (!initialized) {
         return "ERROR: Solver not initialized";
     }
@@ -692,57 +952,832 @@ string solve(const string& facelet_string) {
         return "ERROR: Impossible cube state";
     }
 
-    // Check if already solved
-    if (is_solved(start_state)) {
-        return "";  // Empty solution for solved cube
+    vector<Move> solution;
+    // Check if already solved (empty solution)
+    if (!is_solved(start_state)) {
+        string error;
+        if (!solve_moves(start_state, solution, error)) {
+            return error;
+        }
     }
 
-    vector<Move> p1_sol;
-    CubeState p1_end = start_state;
-    
-    int threshold = h_p1(start_state);
-    while(true) {
-        if(solve_p1(start_state, 0, threshold, p1_sol, None)) break;
-        threshold++;
-        if (threshold > 12) return "ERROR: Phase 1 exceeded depth limit";
+    session.valid = true;
+    session.state = start_state;
+    session.solution = solution;
+    return moves_to_string(solution);
+}
+
+// Re-solves after `applied_moves` (e.g. "R U'") were made on the session's last state. Cheap
+// candidates are tried first: undoing the new moves in front of the old solution, and a short
+// search to any intermediate state of the old solution. A full solve only runs if the best of
+// these is longer than INCREMENTAL_MAX_LENGTH, and its result is kept only if it is shorter.
+string resolve_incremental(SolveSession &session, const string& applied_moves) {
+    if (!initialized) {
+        return "ERROR: Solver not initialized";
     }
 
-    for(Move m : p1_sol) {
-        p1_end = applyMove(p1_end, m);
+    if (!session.valid) {
+        return "ERROR: Session has no previous solve";
     }
 
-    vector<Move> p2_sol;
-    Move last_p1 = (p1_sol.empty() ? None : p1_sol.back());
-    
-    threshold = h_p2(p1_end);
-    while(true) {
-        if(solve_p2(p1_end, 0, threshold, p2_sol, last_p1)) break;
-        threshold++;
-        if (threshold > 18) return "ERROR: Phase 2 exceeded depth limit";
+    vector<Move> applied;
+    if (!parse_moves(applied_moves, applied)) {
+        return "ERROR: Invalid move sequence";
     }
 
-    ostringstream result;
-    for(size_t i = 0; i < p1_sol.size(); i++) {
-        if(i > 0) result << " ";
-        result << move_strings[p1_sol[i]];
+    CubeState state = session.state;
+    for (Move m : applied) state = applyMove(state, m);
+
+    vector<Move> best;
+    for (auto it = applied.rbegin(); it != applied.rend(); ++it) best.push_back(inverse_move(*it));
+    best.insert(best.end(), session.solution.begin(), session.solution.end());
+    best = simplify_moves(best);
+
+    vector<CubeState> targets(1, session.state);
+    for (Move m : session.solution) targets.push_back(applyMove(targets.back(), m));
+
+    vector<Move> path;
+    search_intermediates(state, INCREMENTAL_SEARCH_DEPTH, FSM_START, path, targets, session.solution, best);
+
+    if ((int)best.size() > INCREMENTAL_MAX_LENGTH) {
+        vector<Move> full;
+        string error;
+        if (solve_moves(state, full, error) && full.size() < best.size()) {
+            best = full;
+        }
     }
-    for(size_t i = 0; i < p2_sol.size(); i++) {
-        if(i > 0 || !p1_sol.empty()) result << " ";
-        result << move_strings[p2_sol[i]];
+
+    session.state = state;
+    session.solution = best;
+    return moves_to_string(best);
+}
+
+string solve(const string& facelet_string) {
+    SolveSession session;
+    return solve_session(session, facelet_string);
+}
+
+// =================================================================================================
+// --- POCKET CUBE (2x2x2) ---
+// =================================================================================================
+
+// A 2x2x2 is the corner set of the 3x3x3. With DBL held fixed only U, R and F turns are needed,
+// leaving 7! * 3^6 = 3,674,160 states, so a complete distance table fits in 1.8 MB of nibbles and
+// optimal solutions are read off it by descent with no search. Input is 24 facelets in URFDLB face
+// order, four per face in reading order (the corner facelets of the 3x3 layout).
+const int POCKET_CP = 5040;
+const int POCKET_CO = 729;
+const int POCKET_STATES = POCKET_CP * POCKET_CO;
+// Known number of states at each distance; a loaded table must reproduce these exactly.
+const int pocket_depth_counts[12] = {1, 9, 54, 321, 1847, 9992, 50136, 227536, 870072, 1887748, 623800, 2644};
+
+// applyMove's U cycle turns the U layer opposite to a physical clockwise U (R and F agree with the
+// physical turns), so each output name is paired with the engine move that performs that turn.
+const Move pocket_moves[9] = {Ux3, Ux2, Ux1, Rx1, Rx2, Rx3, Fx1, Fx2, Fx3};
+const char* pocket_move_strings[9] = {"U", "U2", "U'", "R", "R2", "R'", "F", "F2", "F'"};
+
+// Facelet indices for each corner of the 24-facelet layout, listed clockwise from the U/D facelet
+int pocketFacelet[8][3] = {
+    {3, 4, 9},    // URF
+    {2, 8, 17},   // UFL
+    {0, 16, 21},  // ULB
+    {1, 20, 5},   // UBR
+    {13, 11, 6},  // DFR
+    {12, 19, 10}, // DLF
+    {14, 23, 18}, // DBL
+    {15, 7, 22}   // DRB
+};
+
+vector<uint16_t> pocket_cp_move;   // cp coord x move -> cp coord
+vector<uint16_t> pocket_co_move;   // co coord x move -> co coord
+vector<uint8_t> pocket_table;      // two distances per byte, 0xF = unreached
+once_flag pocket_once;
+
+// Permutation of the seven corners other than DBL, relabelled so DRB (7) becomes 6.
+int get_pocket_cp_coord(const CubeState &s) {
+    int vals[7];
+    for (int i = 0, k = 0; i < 8; i++) {
+        if (i == DBL) continue;
+        vals[k++] = s.cp[i] == DRB ? DBL : s.cp[i];
     }
-    
-    return result.str();
+    int coord = 0;
+    for (int i = 0; i < 7; i++) {
+        int count = 0;
+        for (int j = i + 1; j < 7; j++) {
+            if (vals[j] < vals[i]) count++;
+        }
+        coord += count * factorial[6 - i];
+    }
+    return coord;
+}
+
+void set_pocket_cp_coord(CubeState &s, int coord) {
+    vector<int> vals(7);
+    iota(vals.begin(), vals.end(), 0);
+    for (int i = 0, k = 0; i < 8; i++) {
+        if (i == DBL) { s.cp[i] = DBL; continue; }
+        int fact = factorial[6 - k++];
+        int idx = coord / fact;
+        s.cp[i] = vals[idx] == DBL ? DRB : vals[idx];
+        vals.erase(vals.begin() + idx);
+        coord %= fact;
+    }
+}
+
+// Orientation of corners 0-5; DBL stays 0 and DRB is fixed by the orientation sum.
+int get_pocket_co_coord(const CubeState &s) {
+    return get_co_coord(s) / 3;
+}
+
+void set_pocket_co_coord(CubeState &s, int coord) {
+    set_co_coord(s, coord * 3);
+}
+
+int pocket_dist(int idx) {
+    return (pocket_table[idx >> 1] >> ((idx & 1) * 4)) & 0xF;
+}
+
+void set_pocket_dist(int idx, int d) {
+    uint8_t &b = pocket_table[idx >> 1];
+    int shift = (idx & 1) * 4;
+    b = (uint8_t)((b & ~(0xF << shift)) | (d << shift));
+}
+
+int pocket_child(int idx, int m) {
+    return pocket_cp_move[(idx / POCKET_CO) * 9 + m] * POCKET_CO + pocket_co_move[(idx % POCKET_CO) * 9 + m];
+}
+
+void gen_pocket_table() {
+    pocket_table.assign((POCKET_STATES + 1) / 2, 0xFF);
+    set_pocket_dist(0, 0);
+    for (int d = 0, found = 1; found; d++) {
+        found = 0;
+        for (int idx = 0; idx < POCKET_STATES; idx++) {
+            if (pocket_dist(idx) != d) continue;
+            for (int m = 0; m < 9; m++) {
+                int child = pocket_child(idx, m);
+                if (pocket_dist(child) == 0xF) { set_pocket_dist(child, d + 1); found++; }
+            }
+        }
+    }
+}
+
+bool load_pocket_table(const string &filename) {
+    pocket_table.assign((POCKET_STATES + 1) / 2, 0xFF);
+    ifstream in(filename, ios::binary);
+    if (!in) return false;
+    in.read(reinterpret_cast<char*>(pocket_table.data()), pocket_table.size());
+    if (in.gcount() != (streamsize)pocket_table.size()) return false;
+
+    int counts[16] = {0};
+    for (int idx = 0; idx < POCKET_STATES; idx++) counts[pocket_dist(idx)]++;
+    for (int d = 0; d < 16; d++) {
+        if (counts[d] != (d < 12 ? pocket_depth_counts[d] : 0)) return false;
+    }
+    return pocket_dist(0) == 0;
+}
+
+void initialize_pocket_solver() {
+    pocket_cp_move.resize(POCKET_CP * 9);
+    for (int c = 0; c < POCKET_CP; c++) {
+        CubeState s; set_pocket_cp_coord(s, c);
+        for (int m = 0; m < 9; m++) pocket_cp_move[c * 9 + m] = get_pocket_cp_coord(applyMove(s, pocket_moves[m]));
+    }
+    pocket_co_move.resize(POCKET_CO * 9);
+    for (int c = 0; c < POCKET_CO; c++) {
+        CubeState s; set_pocket_co_coord(s, c);
+        for (int m = 0; m < 9; m++) pocket_co_move[c * 9 + m] = get_pocket_co_coord(applyMove(s, pocket_moves[m]));
+    }
+
+    if (!load_pocket_table(pdb_path + "/pocket.pdb")) {
+        gen_pocket_table();
+        ofstream out(pdb_path + "/pocket.pdb", ios::binary);
+        out.write(reinterpret_cast<const char*>(pocket_table.data()), pocket_table.size());
+    }
+}
+
+char opposite_color(char c) {
+    switch (c) {
+    case 'U': return 'D'; case 'D': return 'U';
+    case 'R': return 'L'; case 'L': return 'R';
+    case 'F': return 'B'; case 'B': return 'F';
+    }
+    return '?';
+}
+
+// Without centres the colour scheme is taken from the corner in the DBL slot: its colours are
+// renamed D, B, L and their opposites U, F, R, so that corner is solved by definition.
+bool parse_pocket_facelets(const string &f, CubeState &c) {
+    if (f.size() != 24) return false;
+
+    char d = f[pocketFacelet[DBL][0]], b = f[pocketFacelet[DBL][1]], l = f[pocketFacelet[DBL][2]];
+    // The three colours must lie on three different axes: distinct and mutually non-opposite.
+    for (char col : {d, b, l}) {
+        if (opposite_color(col) == '?') return false;
+    }
+    if (d == b || d == l || b == l || d == opposite_color(b) || d == opposite_color(l) || b == opposite_color(l)) {
+        return false;
+    }
+
+    char rename[128] = {0};
+    rename[(int)d] = 'D'; rename[(int)opposite_color(d)] = 'U';
+    rename[(int)b] = 'B'; rename[(int)opposite_color(b)] = 'F';
+    rename[(int)l] = 'L'; rename[(int)opposite_color(l)] = 'R';
+
+    bool seen[8] = {false};
+    for(int i=0; i<8; i++) {
+        char colors[3];
+        int ori = -1;
+        for(int o=0; o<3; o++) {
+            char col = f[pocketFacelet[i][o]];
+            if (col < 0 || !rename[(int)col]) return false;
+            colors[o] = rename[(int)col];
+            if(ori == -1 && (colors[o] == 'U' || colors[o] == 'D')) ori = o;
+        }
+        if(ori == -1) return false;
+        c.co[i] = ori;
+
+        bool found = false;
+        for(int target=0; target<8 && !found; target++) {
+            int match = 0;
+            for(char ch : colors) {
+                for(int k=0; k<3; k++) if(cornerColor[target][k] == ch) match++;
+            }
+            if(match == 3) { c.cp[i] = target; found = true; }
+        }
+        if (!found || seen[c.cp[i]]) return false;
+        seen[c.cp[i]] = true;
+    }
+    return c.cp[DBL] == DBL && c.co[DBL] == 0;
+}
+
+string solve_2x2(const string& facelet_string) {
+    if (!initialized) {
+        return "ERROR: Solver not initialized";
+    }
+
+    if (facelet_string.length() != 24) {
+        return "ERROR: Invalid input length";
+    }
+
+    call_once(pocket_once, initialize_pocket_solver);
+
+    CubeState state;
+    if (!parse_pocket_facelets(facelet_string, state)) {
+        return "ERROR: Invalid cube configuration";
+    }
+
+    int co_sum = 0;
+    for (int i = 0; i < 8; i++) co_sum += state.co[i];
+    if (co_sum % 3 != 0) {
+        return "ERROR: Impossible cube state";
+    }
+
+    ostringstream solution;
+    int idx = get_pocket_cp_coord(state) * POCKET_CO + get_pocket_co_coord(state);
+    for (int d = pocket_dist(idx); d > 0; d--) {
+        int next = -1;
+        for (int m = 0; m < 9 && next == -1; m++) {
+            int child = pocket_child(idx, m);
+            if (pocket_dist(child) == d - 1) {
+                next = child;
+                solution << (solution.tellp() > 0 ? " " : "") << pocket_move_strings[m];
+            }
+        }
+        if (next == -1) {
+            return "ERROR: Pocket table inconsistent";
+        }
+        idx = next;
+    }
+    return solution.str();
+}
+
+vector<string> solve_2x2_batch(const vector<string>& facelet_strings) {
+    vector<string> results;
+    results.reserve(facelet_strings.size());
+    for (const string &f : facelet_strings) results.push_back(solve_2x2(f));
+    return results;
+}
+
+// Physical states (single turns and random scrambles) with their expected optimal solutions, so the
+// facelet layout and move directions stay pinned down. Run with `solver --check-2x2`.
+struct PocketFixture { const char* facelets; const char* solution; };
+const PocketFixture pocket_fixtures[] = {
+    {"UUUURRRRFFFFDDDDLLLLBBBB", ""},
+    {"UUUUBBRRRRFFDDDDFFLLLLBB", "U'"},          // U
+    {"UUUUFFRRLLFFDDDDBBLLRRBB", "U"},           // U'
+    {"UFUFRRRRFDFDDBDBLLLLUBUB", "R'"},          // R
+    {"UDUDRRRRFBFBDUDULLLLFBFB", "R2"},          // R2
+    {"UULLURURFFFFRRDDLDLDBBBB", "F'"},          // F
+    {"UUUURRFFFFLLDDDDLLBBBBRR", "U'"},          // D, same as U with DBL held fixed
+    {"RRLUFDDFDLLRBFBLFBUUBUDR", "R' U F' U2 F R U' R2"},
+    {"BDDBDLLUFRUDFFUFURRLBLRB", "U' F R' U' F2 U' R2 F'"},
+    {"BFRBDLBUDRULFUFRLFRLDDBU", "R F2 R' F2 U F2 U F' R F"},
+    {"LFFLDRDRRBDFRLUBBDLBUUUF", "U2 R' U2 F' R U2 F' U2"},
+};
+
+bool check_pocket_fixtures() {
+    bool ok = true;
+    for (const PocketFixture &fx : pocket_fixtures) {
+        string result = solve_2x2(fx.facelets);
+        if (result != fx.solution) {
+            cout << "FAIL " << fx.facelets << ": expected \"" << fx.solution << "\", got \"" << result << "\"" << endl;
+            ok = false;
+        }
+    }
+    cout << (ok ? "All 2x2 fixtures passed" : "2x2 fixtures FAILED") << endl;
+    return ok;
+}
+
+// =================================================================================================
+// --- BENCHMARK ---
+// =================================================================================================
+
+// Scrambles are kept short: deep random scrambles take seconds each on the current search.
+const int BENCH_SCRAMBLE_LENGTH = 10;
+const int BENCH_DEFAULT_COUNT = 10;
+
+// Solves the same seeded random scrambles with and without prefetched node expansion.
+void run_benchmark(int count) {
+    mt19937 rng(12345);
+    vector<CubeState> scrambles;
+    for (int i = 0; i < count; i++) {
+        CubeState s;
+        for (int k = 0; k < BENCH_SCRAMBLE_LENGTH; k++) s = applyMove(s, (Move)(rng() % 18));
+        scrambles.push_back(s);
+    }
+
+    vector<string> results[2];
+    for (int mode = 0; mode < 2; mode++) {
+        prefetch_lookups = (mode == 0);
+        auto start = chrono::steady_clock::now();
+        for (const CubeState &s : scrambles) {
+            vector<Move> solution;
+            string error;
+            results[mode].push_back(solve_moves(s, solution, error) ? moves_to_string(solution) : error);
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << (mode == 0 ? "prefetched:  " : "sequential:  ") << ms << " ms total, "
+             << ms / count << " ms/solve" << endl;
+    }
+    prefetch_lookups = true;
+
+    if (results[0] != results[1]) cout << "WARNING: lookup orders produced different solutions" << endl;
+}
+
+// =================================================================================================
+// --- CORPUS COORDINATOR ---
+// =================================================================================================
+
+// Large corpora are split into chunks and solved by worker processes that connect to the
+// coordinator over TCP, either spawned locally or started by hand on other hosts. The protocol is
+// line based:
+//   worker      -> coordinator:  READY <pid>
+//   coordinator -> worker:       CHUNK <id> <n>, then n cube lines  |  QUIT
+//   worker      -> coordinator:  RESULT <id> <n>, then n lines "<ms>\t<solution or ERROR...>"
+// Each finished chunk is appended to "<output>.ckpt" together with its cubes, so an interrupted run
+// resumes where it left off as long as the corpus is unchanged. When no chunk is left to hand out, idle workers duplicate the oldest running chunk and the
+// first result to arrive wins.
+struct CoordinatorOptions {
+    string corpus_file;
+    string output_file;
+    string bind_addr = "127.0.0.1";
+    int port = 0;               // 0 picks a free port
+    int workers = 0;            // local worker processes to spawn
+    int chunk_size = 64;
+};
+
+struct CorpusChunk {
+    int first = 0;
+    int count = 0;
+    bool done = false;
+    int running = 0;            // workers currently solving this chunk
+    chrono::steady_clock::time_point dispatched;
+    vector<string> results;     // "<ms>\t<result>" per cube
+};
+
+struct WorkerConn {
+    int fd = -1;
+    string inbuf;
+    string outbuf;              // queued bytes the socket has not accepted yet
+    bool ready = false;
+    pid_t pid = 0;              // as reported by the worker; matches a local child if we spawned it
+    int chunk = -1;             // chunk being solved, -1 when idle
+    int result_chunk = -1;      // RESULT currently being read
+    int expect = 0;
+    vector<string> lines;
+};
+
+bool send_all(int fd, const string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Sends as much of the queued output as the socket takes without blocking, so a slow reader never
+// stalls the coordinator's poll loop. Returns false if the connection failed.
+bool flush_output(WorkerConn &w) {
+    while (!w.outbuf.empty()) {
+        ssize_t n = send(w.fd, w.outbuf.data(), w.outbuf.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) { w.outbuf.erase(0, n); continue; }
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    }
+    return true;
+}
+
+// Blocking line read for the worker side; buf keeps bytes past the returned line.
+bool read_line(int fd, string &buf, string &line) {
+    size_t pos;
+    while ((pos = buf.find('\n')) == string::npos) {
+        char tmp[4096];
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n <= 0) return false;
+        buf.append(tmp, n);
+    }
+    line = buf.substr(0, pos);
+    buf.erase(0, pos + 1);
+    return true;
+}
+
+int connect_to(const string &host, int port) {
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int run_worker(const string &host, int port) {
+    int fd = connect_to(host, port);
+    if (fd < 0) {
+        cerr << "ERROR: Cannot connect to coordinator at " << host << ":" << port << endl;
+        return 1;
+    }
+
+    string buf, line;
+    if (!send_all(fd, "READY " + to_string(getpid()) + "\n")) { close(fd); return 1; }
+    while (read_line(fd, buf, line)) {
+        istringstream header(line);
+        string tag;
+        int id = 0, n = 0;
+        header >> tag >> id >> n;
+        if (tag != "CHUNK") break;
+
+        ostringstream out;
+        out << "RESULT " << id << " " << n << "\n";
+        for (int i = 0; i < n; i++) {
+            if (!read_line(fd, buf, line)) { close(fd); return 1; }
+            auto start = chrono::steady_clock::now();
+            string result = line.length() == 24 ? solve_2x2(line) : solve(line);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            out << ms << "\t" << result << "\n";
+        }
+        if (!send_all(fd, out.str())) break;
+    }
+    close(fd);
+    return 0;
+}
+
+// Checkpoint lines are "<cube>\t<ms>\t<result>", so a resumed run can tell whether the corpus
+// still holds the same cubes.
+void write_checkpoint_chunk(ostream &out, int id, const CorpusChunk &chunk, const vector<string> &corpus) {
+    out << "CHUNK " << id << " " << chunk.count << "\n";
+    for (int i = 0; i < chunk.count; i++) out << corpus[chunk.first + i] << "\t" << chunk.results[i] << "\n";
+    out << "END " << id << "\n";
+}
+
+// Reads chunks completed by an earlier run. A chunk only counts if its END marker was written and
+// every cube in it matches the current corpus.
+int load_checkpoint(const string &filename, vector<CorpusChunk> &chunks, const vector<string> &corpus) {
+    ifstream in(filename);
+    string line;
+    int resumed = 0;
+    while (getline(in, line)) {
+        istringstream header(line);
+        string tag;
+        int id = -1, n = 0;
+        header >> tag >> id >> n;
+        if (tag != "CHUNK" || id < 0 || id >= (int)chunks.size() || n != chunks[id].count) break;
+
+        vector<string> results(n);
+        bool matches = true;
+        for (int i = 0; i < n; i++) {
+            if (!getline(in, line)) return resumed;
+            size_t tab = line.find('\t');
+            if (tab == string::npos || line.compare(0, tab, corpus[chunks[id].first + i]) != 0) matches = false;
+            else results[i] = line.substr(tab + 1);
+        }
+        if (!getline(in, line) || line != "END " + to_string(id)) return resumed;
+        if (!matches) {
+            cerr << "Checkpoint chunk " << id << " no longer matches the corpus, solving it again" << endl;
+            continue;
+        }
+        if (!chunks[id].done) resumed++;
+        chunks[id].done = true;
+        chunks[id].results = results;
+    }
+    return resumed;
+}
+
+void dispatch_chunks(map<int, WorkerConn> &conns, vector<CorpusChunk> &chunks, const vector<string> &corpus) {
+    for (auto &entry : conns) {
+        WorkerConn &w = entry.second;
+        if (!w.ready || w.chunk != -1) continue;
+
+        int pick = -1;
+        for (size_t c = 0; c < chunks.size() && pick == -1; c++) {
+            if (!chunks[c].done && chunks[c].running == 0) pick = (int)c;
+        }
+        // Nothing left to hand out: help with the longest-running straggler.
+        for (size_t c = 0; c < chunks.size() && pick == -1; c++) {
+            if (chunks[c].done || chunks[c].running != 1) continue;
+            if (pick == -1 || chunks[c].dispatched < chunks[pick].dispatched) pick = (int)c;
+        }
+        if (pick == -1) continue;
+
+        CorpusChunk &chunk = chunks[pick];
+        ostringstream out;
+        out << "CHUNK " << pick << " " << chunk.count << "\n";
+        for (int i = 0; i < chunk.count; i++) out << corpus[chunk.first + i] << "\n";
+        w.outbuf += out.str();
+        flush_output(w);        // failures surface as POLLERR/POLLHUP on the next poll
+        if (chunk.running == 0) chunk.dispatched = chrono::steady_clock::now();
+        chunk.running++;
+        w.chunk = pick;
+    }
+}
+
+// Consumes complete lines from a worker. Returns false if the worker broke the protocol.
+bool handle_worker_input(WorkerConn &w, vector<CorpusChunk> &chunks, const vector<string> &corpus,
+                         ofstream &checkpoint) {
+    size_t pos;
+    while ((pos = w.inbuf.find('\n')) != string::npos) {
+        string line = w.inbuf.substr(0, pos);
+        w.inbuf.erase(0, pos + 1);
+
+        if (w.expect > 0) {
+            w.lines.push_back(line);
+            if (--w.expect > 0) continue;
+
+            CorpusChunk &chunk = chunks[w.result_chunk];
+            if (!chunk.done) {
+                chunk.done = true;
+                chunk.results = w.lines;
+                write_checkpoint_chunk(checkpoint, w.result_chunk, chunk, corpus);
+                checkpoint.flush();
+            }
+            chunk.running--;
+            w.chunk = -1;
+            w.lines.clear();
+            continue;
+        }
+
+        istringstream header(line);
+        string tag;
+        int id = -1, n = 0;
+        header >> tag >> id >> n;
+        if (tag == "READY") {
+            w.ready = true;
+            w.pid = id;
+        } else if (tag == "RESULT" && id >= 0 && id < (int)chunks.size() && id == w.chunk &&
+                   n == chunks[id].count && n > 0) {
+            w.result_chunk = id;
+            w.expect = n;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void print_corpus_stats(const vector<CorpusChunk> &chunks, double wall_ms, int resumed) {
+    int total = 0, errors = 0;
+    long long moves = 0;
+    int longest = 0;
+    double solve_ms = 0;
+    map<int, int> lengths;
+    for (const CorpusChunk &chunk : chunks) {
+        for (const string &r : chunk.results) {
+            size_t tab = r.find('\t');
+            string result = r.substr(tab + 1);
+            total++;
+            solve_ms += atof(r.c_str());
+            if (result.rfind("ERROR", 0) == 0) { errors++; continue; }
+            int len = 0;
+            istringstream in(result);
+            string token;
+            while (in >> token) len++;
+            moves += len;
+            longest = max(longest, len);
+            lengths[len]++;
+        }
+    }
+
+    int solved = total - errors;
+    cout << "Solved " << solved << "/" << total << " cubes (" << errors << " errors, "
+         << resumed << " chunks resumed from checkpoint) in " << wall_ms / 1000 << " s" << endl;
+    if (total > 0) cout << "Mean solve time: " << solve_ms / total << " ms" << endl;
+    if (solved > 0) {
+        cout << "Solution length: mean " << (double)moves / solved << ", max " << longest << endl;
+        for (auto &entry : lengths) cout << "  " << entry.first << " moves: " << entry.second << endl;
+    }
+}
+
+int run_coordinator(const CoordinatorOptions &opt, const char* self) {
+    auto start = chrono::steady_clock::now();
+
+    vector<string> corpus;
+    {
+        ifstream in(opt.corpus_file);
+        if (!in) { cerr << "ERROR: Cannot read corpus " << opt.corpus_file << endl; return 1; }
+        string line;
+        while (getline(in, line)) {
+            line.erase(remove_if(line.begin(), line.end(), [](unsigned char ch) { return isspace(ch); }), line.end());
+            if (!line.empty()) corpus.push_back(line);
+        }
+    }
+
+    vector<CorpusChunk> chunks;
+    for (int first = 0; first < (int)corpus.size(); first += opt.chunk_size) {
+        CorpusChunk chunk;
+        chunk.first = first;
+        chunk.count = min(opt.chunk_size, (int)corpus.size() - first);
+        chunks.push_back(chunk);
+    }
+
+    string checkpoint_file = opt.output_file + ".ckpt";
+    int resumed = load_checkpoint(checkpoint_file, chunks, corpus);
+    // Rewrite the checkpoint so a torn tail from the interrupted run is dropped.
+    ofstream checkpoint(checkpoint_file, ios::trunc);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        if (chunks[c].done) write_checkpoint_chunk(checkpoint, (int)c, chunks[c], corpus);
+    }
+    checkpoint.flush();
+
+    auto all_done = [&]() {
+        return all_of(chunks.begin(), chunks.end(), [](const CorpusChunk &c) { return c.done; });
+    };
+
+    vector<pid_t> children;
+    vector<pid_t> stragglers;   // local workers that were not told to quit
+    if (!all_done()) {
+        int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(opt.port);
+        socklen_t addr_len = sizeof(addr);
+        if (inet_pton(AF_INET, opt.bind_addr.c_str(), &addr.sin_addr) != 1 ||
+            ::bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0 ||
+            getsockname(listen_fd, (sockaddr*)&addr, &addr_len) != 0) {
+            cerr << "ERROR: Cannot listen on " << opt.bind_addr << ":" << opt.port << endl;
+            return 1;
+        }
+        int port = ntohs(addr.sin_port);
+        cout << "Coordinator listening on " << opt.bind_addr << ":" << port << ", "
+             << chunks.size() << " chunks" << endl;
+
+        string local_host = opt.bind_addr == "0.0.0.0" ? "127.0.0.1" : opt.bind_addr;
+        for (int i = 0; i < opt.workers; i++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(listen_fd);
+                execl(self, self, "--worker", local_host.c_str(), to_string(port).c_str(), (char*)nullptr);
+                _exit(127);
+            }
+            if (pid > 0) children.push_back(pid);
+        }
+
+        map<int, WorkerConn> conns;
+        while (!all_done()) {
+            vector<pollfd> fds(1, pollfd{listen_fd, POLLIN, 0});
+            for (auto &entry : conns) {
+                short events = POLLIN | (entry.second.outbuf.empty() ? 0 : POLLOUT);
+                fds.push_back(pollfd{entry.first, events, 0});
+            }
+            if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) break;
+
+            if (fds[0].revents & POLLIN) {
+                int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd >= 0) conns[fd].fd = fd;
+            }
+            for (size_t i = 1; i < fds.size(); i++) {
+                WorkerConn &w = conns[fds[i].fd];
+                bool alive = true;
+                if (fds[i].revents & POLLOUT) alive = flush_output(w);
+                if (alive && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                    char tmp[65536];
+                    ssize_t n = recv(w.fd, tmp, sizeof(tmp), 0);
+                    if (n > 0) w.inbuf.append(tmp, n);
+                    alive = n > 0 && handle_worker_input(w, chunks, corpus, checkpoint);
+                }
+                if (!alive) {
+                    if (w.chunk != -1) chunks[w.chunk].running--;
+                    close(w.fd);
+                    conns.erase(fds[i].fd);
+                }
+            }
+
+            for (auto it = children.begin(); it != children.end();) {
+                it = waitpid(*it, nullptr, WNOHANG) == 0 ? it + 1 : children.erase(it);
+            }
+            if (opt.workers > 0 && children.empty() && conns.empty()) {
+                cerr << "ERROR: All workers exited before the corpus was solved" << endl;
+                return 1;
+            }
+            dispatch_chunks(conns, chunks, corpus);
+        }
+
+        // Workers still busy with a duplicate chunk just see the connection close.
+        vector<pid_t> quit;
+        for (auto &entry : conns) {
+            if (entry.second.chunk == -1 && entry.second.outbuf.empty() &&
+                send(entry.first, "QUIT\n", 5, MSG_NOSIGNAL | MSG_DONTWAIT) == 5) {
+                quit.push_back(entry.second.pid);
+            }
+            close(entry.first);
+        }
+        close(listen_fd);
+        for (pid_t pid : children) {
+            if (find(quit.begin(), quit.end(), pid) == quit.end()) stragglers.push_back(pid);
+        }
+    }
+
+    ofstream out(opt.output_file);
+    for (const CorpusChunk &chunk : chunks) {
+        for (int i = 0; i < chunk.count; i++) {
+            const string &r = chunk.results[i];
+            out << corpus[chunk.first + i] << "\t" << r.substr(r.find('\t') + 1) << "\n";
+        }
+    }
+    out.close();
+    checkpoint.close();
+    remove(checkpoint_file.c_str());
+
+    print_corpus_stats(chunks, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(), resumed);
+
+    // The output is already written; a slow or hung local worker must not hold up the run.
+    for (pid_t pid : stragglers) {
+        kill(pid, SIGTERM);
+        kill(pid, SIGCONT);     // a stopped process only acts on SIGTERM once continued
+    }
+    for (pid_t pid : children) waitpid(pid, nullptr, 0);
+    return 0;
 }
 
 #ifndef PYBIND11_BUILD
-int main() {
+int main(int argc, char** argv) {
     initialize_solver("./pdb");
+    wait_solver_ready();
+
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        run_benchmark(argc >= 3 ? max(1, atoi(argv[2])) : BENCH_DEFAULT_COUNT);
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--check-2x2") == 0) {
+        return check_pocket_fixtures() ? 0 : 1;
+    }
+
+    if (argc >= 4 && strcmp(argv[1], "--worker") == 0) {
+        return run_worker(argv[2], atoi(argv[3]));
+    }
+
+    // --coordinate <corpus> <output> [--workers N] [--chunk K] [--bind ADDR] [--port P]
+    if (argc >= 4 && strcmp(argv[1], "--coordinate") == 0) {
+        CoordinatorOptions opt;
+        opt.corpus_file = argv[2];
+        opt.output_file = argv[3];
+        opt.workers = max(1u, thread::hardware_concurrency());
+        for (int i = 4; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--workers") == 0) opt.workers = max(0, atoi(argv[i + 1]));
+            else if (strcmp(argv[i], "--chunk") == 0) opt.chunk_size = max(1, atoi(argv[i + 1]));
+            else if (strcmp(argv[i], "--bind") == 0) opt.bind_addr = argv[i + 1];
+            else if (strcmp(argv[i], "--port") == 0) opt.port = atoi(argv[i + 1]);
+        }
+        return run_coordinator(opt, "/proc/self/exe");
+    }
     
     string input;
-    cout << "Enter cube (54 chars, URFDLB order):" << endl;
+    cout << "Enter cube (54 chars, or 24 for 2x2x2, URFDLB order):" << endl;
     if (!(cin >> input)) return 0;
 
-    string result = solve(input);
+    string result = input.length() == 24 ? solve_2x2(input) : solve(input);
     cout << "Result: " << result << endl;
 
     return 0;